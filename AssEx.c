@@ -1,9 +1,18 @@
+#define _POSIX_C_SOURCE 200809L // getline, ssize_t, clock_gettime
+#define _DEFAULT_SOURCE // flock, MAP_SHARED
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // global variables
 enum {LCS, ED, SW, NONE} alg_type; // which algorithm to run
@@ -11,10 +20,27 @@ char *alg_desc; // description of which algorithm to run
 char *result_string; // text to print along with result from algorithm
 char *x, *y; // the two strings that the algorithm will execute on
 char *filename; // file containing the two strings
+char *mappedFile = NULL; // file mapped into memory by readStrings, which x and y point into
+size_t mappedSize; // size of mapped file
 int xLen, yLen, alphabetSize; // lengths of two strings and size of alphabet
 bool iterBool = false, recNoMemoBool = false, recMemoBool = false; // which type of dynamic programming to run
 bool printBool = false; // whether to print table
+bool alignBool = false; // whether to print an optimal alignment
 bool readFileBool = false, genStringsBool = false; // whether to read in strings from file or generate strings randomly
+bool seedBool = false, mutateBool = false, outFileBool = false; // whether seed given, whether y derived from x, whether to write generated strings to file
+uint64_t seed; // seed for the pseudo-random number generator
+int mutateRate; // percentage of positions of x mutated (substitution/insertion/deletion) to derive y
+char *outFilename; // file to write generated strings to
+int numThreads = 1; // number of threads used to generate strings or compute all pairs
+bool threadsBool = false; // whether number of threads given
+bool autoBool = false, calibrateBool = false; // whether to choose type of dynamic programming and threads automatically, whether to write a calibration file
+char *calibFilename; // calibration file read by automatic choice and written by calibration
+bool cacheBool = false; // whether to look up and store results in a cache file
+char *cacheFilename; // cache file of results
+bool allPairsBool = false; // whether to compute the matrix of all pairs over a set of strings
+char *setFilename, *matrixFilename; // file containing the set of strings (one per line), file to write the matrix to
+bool thresholdBool = false; // whether to abandon pairs early against a threshold
+int threshold; // ED above which, or LCS below which, a pair is abandoned
 
 // NEW VARIABLES
 //Struct for tuple in a table containing value and pointer to secondary array
@@ -35,6 +61,18 @@ compTableTuple *comp_array; //1d array of compTableTuples
 long long ins_count = 0; //Insertion count
 int answer = 0; //Final answers from algorithms
 long long rec_counter = 0; //A counter for recursive calls
+bool analyticBool = false; //Whether to count recursive calls analytically instead of recursing
+typedef unsigned __int128 bigCount; //128-bit counter for analytic recursion counts
+bigCount *count_table; //Per-cell recursion counts (whole table if printing, else two rows)
+bigCount rec_count_big = 0; //Analytic count of recursive calls
+bool count_overflow = false; //Whether a count exceeded 128 bits
+double rec_count_log = 0; //Natural logarithm of count of recursive calls, set once a count exceeds 128 bits
+
+//Traceback - 2-bit direction per cell, 32 cells per word, filled during the forward pass
+enum {TB_STOP, TB_DIAG, TB_UP, TB_LEFT};
+uint64_t *traceback = NULL; //Traceback words, row-major over (xLen+1)*(yLen+1) cells
+int align_end_i, align_end_j; //Cell an alignment ends at
+bool rollingTable = false; //Whether table holds only two rows (reused alternately) and no companion array
 //NEW VARIABLES END
 
 
@@ -77,12 +115,98 @@ bool getArgs(int argc, char *argv[]) {
 			else
 				return true; // must have been an error with -f argument
 		}
+		else if (strcmp(argv[i],"-s")==0) { // seed for generating strings
+			if (argc>=i+2 && isNum(argv[i+1])) { // must be one numerical argument after this
+				i++;
+				seed = strtoull(argv[i], NULL, 10); // get seed
+				seedBool = true; // set flag to use given seed
+			}
+			else
+				return true; // must have been an error with -s argument
+		}
+		else if (strcmp(argv[i],"-d")==0) { // derive y from x with given percentage of mutations (length of y given to -g is then ignored)
+			if (argc>=i+2 && isNum(argv[i+1]) && atoi(argv[i+1])<=100) { // must be one percentage after this
+				i++;
+				mutateRate = atoi(argv[i]); // get mutation rate
+				mutateBool = true; // set flag to derive y from x
+			}
+			else
+				return true; // must have been an error with -d argument
+		}
+		else if (strcmp(argv[i],"-o")==0) { // write generated strings to file
+			if (argc>=i+2) { // must be one more argument (filename) after this
+				i++;
+				outFilename = argv[i]; // get filename
+				outFileBool = true; // set flag to write strings to file
+			}
+			else
+				return true; // must have been an error with -o argument
+		}
+		else if (strcmp(argv[i],"-j")==0) { // number of threads
+			if (argc>=i+2 && isNum(argv[i+1]) && atoi(argv[i+1])>0) { // must be one positive numerical argument after this
+				i++;
+				numThreads = atoi(argv[i]); // get number of threads
+				threadsBool = true; // set flag to keep given number of threads
+			}
+			else
+				return true; // must have been an error with -j argument
+		}
+		else if (strcmp(argv[i],"-A")==0) { // all pairs over a set of strings
+			if (argc>=i+3) { // must be two more arguments (set filename and matrix filename) after this
+				setFilename = argv[i+1]; // get set filename
+				matrixFilename = argv[i+2]; // get matrix filename
+				allPairsBool = true; // set flag to compute all pairs
+				i+=2; // ready for next argument
+			}
+			else
+				return true; // must have been an error with -A arguments
+		}
+		else if (strcmp(argv[i],"-k")==0) { // threshold for abandoning pairs early
+			if (argc>=i+2 && isNum(argv[i+1])) { // must be one numerical argument after this
+				i++;
+				threshold = atoi(argv[i]); // get threshold
+				thresholdBool = true; // set flag to use threshold
+			}
+			else
+				return true; // must have been an error with -k argument
+		}
+		else if (strcmp(argv[i],"-u")==0) { // choose type of dynamic programming automatically
+			if (argc>=i+2) { // must be one more argument (calibration filename) after this
+				i++;
+				calibFilename = argv[i]; // get calibration filename
+				autoBool = true; // set flag to choose automatically
+			}
+			else
+				return true; // must have been an error with -u argument
+		}
+		else if (strcmp(argv[i],"-C")==0) { // write calibration file
+			if (argc>=i+2) { // must be one more argument (calibration filename) after this
+				i++;
+				calibFilename = argv[i]; // get calibration filename
+				calibrateBool = true; // set flag to calibrate
+			}
+			else
+				return true; // must have been an error with -C argument
+		}
+		else if (strcmp(argv[i],"-c")==0) { // cache of results
+			if (argc>=i+2) { // must be one more argument (cache filename) after this
+				i++;
+				cacheFilename = argv[i]; // get cache filename
+				cacheBool = true; // set flag to use cache
+			}
+			else
+				return true; // must have been an error with -c argument
+		}
 		else if (strcmp(argv[i],"-i")==0) // iterative dynamic programming
 			iterBool = true;
 		else if (strcmp(argv[i],"-r")==0) // recursive dynamic programming without memoisation
 			recNoMemoBool = true;
 		else if (strcmp(argv[i],"-m")==0) // recursive dynamic programming with memoisation
 			recMemoBool = true;
+		else if (strcmp(argv[i],"-a")==0) // count recursive calls without memoisation analytically
+			analyticBool = true;
+		else if (strcmp(argv[i],"-l")==0) // print optimal alignment
+			alignBool = true;
 		else if (strcmp(argv[i],"-p")==0) // print dynamic programming table
 			printBool = true;
 		else if (strcmp(argv[i],"-t")==0) // which algorithm to run
@@ -115,91 +239,212 @@ bool getArgs(int argc, char *argv[]) {
 		// - generate strings with length 0 or alphabet size 0
 		// - no algorithm to run
 		// - no type of dynamic programming
-		return !(readFileBool ^ genStringsBool) || (genStringsBool && (xLen <=0 || yLen <= 0 || alphabetSize <=0)) || alg_type==NONE || (!iterBool && !recMemoBool && !recNoMemoBool);
+		// - seed, mutation or output file without generating strings
+		// - calibration together with anything else
+		if (calibrateBool)
+			return argc != 3;
+		// (when writing generated strings to file no algorithm or type of dynamic programming is needed)
+		if ((seedBool || mutateBool || outFileBool) && !genStringsBool)
+			return true;
+		if (outFileBool)
+			return cacheBool || readFileBool || xLen <=0 || yLen <= 0 || alphabetSize <=0;
+		// all pairs reads its own set of strings and needs only an algorithm; it prints no table or alignment,
+		// runs no other type of dynamic programming and has no threshold for Smith-Waterman
+		if (allPairsBool)
+			return readFileBool || genStringsBool || alg_type==NONE || printBool || alignBool
+				|| iterBool || recMemoBool || recNoMemoBool || analyticBool || (thresholdBool && alg_type==SW);
+		if (thresholdBool || (alignBool && !iterBool && !autoBool))
+			return true;
+		// automatic choice replaces choosing a type of dynamic programming
+		if (autoBool && (iterBool || recMemoBool || recNoMemoBool || analyticBool))
+			return true;
+		return !(readFileBool ^ genStringsBool) || (genStringsBool && (xLen <=0 || yLen <= 0 || alphabetSize <=0)) || alg_type==NONE || (!iterBool && !recMemoBool && !recNoMemoBool && !analyticBool && !autoBool);
 }
 
 // read strings from file; return true if and only if file read successfully
+// the file is mapped into memory and x and y point into the mapping, so nothing is copied
 bool readStrings() {
 	// open file for read given by filename
-	FILE * file;
-	file = fopen(filename, "r");
-	// firstly we will measure the lengths of x and y before we read them in to memory
-	if (file) { // file opened successfully
-		// first measure length of x
-		bool done = false;
-		int i;
-		do { // read from file until newline encountered
-			i = fgetc(file); // get next character
-			if (i==EOF) { // EOF encountered too early (this is first string)
-				// print error message, close file and return false
-				printf("Incorrect file syntax\n");
-				fclose(file);
-				return false;
-			}
-			if ((char) i=='\n' || (char) i=='\r') // newline encountered
-				done = true; // terminate loop
-			else // one more character
-				xLen++; // increment length of x
-		} while (!done);
-		// next measure length of y
-		if ((char) i=='\r')
-			fgetc(file); // get rid of newline character
-		done = false;
-		do { // read from file until newline or EOF encountered
-			int i = fgetc(file); // get next character
-			if (i==EOF || (char) i=='\n' || (char) i=='\r') // EOF or newline encountered
-				done = true; // terminate loop
-			else // one more character
-				yLen++; // increment length of y
-		} while (!done);
-		fclose(file);
-		// if either x or y is empty then print error message and return false
-		if (xLen==0 || yLen==0) {
-			printf("Incorrect file syntax\n");
-			return false;
-		}
-		// now open file again for read
-		file = fopen(filename, "r");
-		// allocate memory for x and y
-		x = malloc(xLen * sizeof(char));
-		y = malloc(yLen * sizeof(char));
-		// read in x character-by-character
-		for (i=0; i<xLen; i++)
-			x[i]=fgetc(file);
-		i = fgetc(file); // read in newline between strings and discard
-		if ((char) i=='\r')
-			fgetc(file); // read \n character and discard if previous character was \r
-		// read in y character-by-character
-		for (i=0; i<yLen; i++)
-			y[i]=fgetc(file);
-		// close file and return boolean indicating success
-		fclose(file);
-		return true;
-	}
-	else { // notify user of I/O error and return false
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) { // notify user of I/O error and return false
+		printf("Problem opening file %s\n",filename);
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) { // nothing to map
+		printf("Incorrect file syntax\n");
+		close(fd);
+		return false;
+	}
+	char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // mapping stays valid
+	if (data == MAP_FAILED) {
 		printf("Problem opening file %s\n",filename);
 		return false;
 	}
+	char *end = data + st.st_size;
+	// x runs up to the first newline, which must be present
+	char *newline = memchr(data, '\n', st.st_size);
+	char *cr = memchr(data, '\r', newline ? newline - data : st.st_size);
+	if (cr)
+		newline = cr;
+	if (!newline) { // EOF encountered too early (this is first string)
+		printf("Incorrect file syntax\n");
+		munmap(data, st.st_size);
+		return false;
+	}
+	x = data;
+	xLen = newline - data;
+	// y starts after the newline (\r followed by one more character counts as one newline) and runs up to the next one or EOF
+	y = newline + ((*newline=='\r') ? 2 : 1);
+	if (y > end)
+		y = end;
+	char *y_end = memchr(y, '\n', end - y);
+	cr = memchr(y, '\r', (y_end ? y_end : end) - y);
+	if (cr)
+		y_end = cr;
+	yLen = (y_end ? y_end : end) - y;
+	// if either x or y is empty then print error message and return false
+	if (xLen==0 || yLen==0) {
+		printf("Incorrect file syntax\n");
+		munmap(data, st.st_size);
+		return false;
+	}
+	mappedFile = data;
+	mappedSize = st.st_size;
+	return true;
+}
+
+// counter-based pseudo-random number generator: the n-th value of a stream depends only on (seed, stream, n),
+// so any part of a string can be generated independently of the rest (and hence in parallel)
+// mix64 - splitmix64 finaliser, scrambles a 64-bit value
+uint64_t mix64(uint64_t z) {
+	z += 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// random_at - n-th pseudo-random value of the given stream
+uint64_t random_at(uint64_t stream, uint64_t n) {
+	return mix64(mix64(seed + stream * 0xD1B54A32D192ED03ULL) + n * 0x9E3779B97F4A7C15ULL);
+}
+
+// part of a string to be filled with random letters by one thread
+typedef struct {
+	char *s; // string to fill
+	long long start, end; // fill s[start..end-1], start a multiple of 4
+	uint64_t stream; // stream of the generator to use
+} fillJob;
+
+// fill_random - fill part of a string with letters uniformly at random; each 64-bit value gives four letters
+void *fill_random(void *arg) {
+	fillJob *job = (fillJob *) arg;
+	long long i;
+	int k;
+	for (i = job->start; i < job->end; i += 4) {
+		uint64_t r = random_at(job->stream, i / 4);
+		for (k = 0; k < 4 && i + k < job->end; k++)
+			job->s[i+k] = (char) ((((r >> (16*k)) & 0xFFFF) * alphabetSize) >> 16) + 'A';
+	}
+	return NULL;
+}
+
+// fill_string - fill a string of length len with random letters using numThreads threads
+void fill_string(char *s, int len, uint64_t stream) {
+	pthread_t *threads = malloc(numThreads * sizeof(pthread_t));
+	fillJob *jobs = malloc(numThreads * sizeof(fillJob));
+	long long chunk = ((len + numThreads - 1) / numThreads + 3) / 4 * 4; // keep chunks aligned to four letters
+	int t;
+	for (t = 0; t < numThreads; t++) {
+		jobs[t].s = s;
+		jobs[t].start = t * chunk < len ? t * chunk : len;
+		jobs[t].end = (t + 1) * chunk < len ? (t + 1) * chunk : len;
+		jobs[t].stream = stream;
+	}
+	bool *started = calloc(numThreads, sizeof(bool));
+	for (t = 1; t < numThreads; t++)
+		started[t] = pthread_create(&threads[t], NULL, fill_random, &jobs[t]) == 0;
+	fill_random(&jobs[0]); // this thread does the first chunk
+	for (t = 1; t < numThreads; t++)
+		if (started[t])
+			pthread_join(threads[t], NULL);
+		else
+			fill_random(&jobs[t]); // thread could not be created; do its chunk here
+	free(started);
+	free(threads);
+	free(jobs);
+}
+
+// mutate_string - derive y from x by substituting, inserting or deleting (equally likely) at mutateRate percent of positions of x
+void mutate_string() {
+	y = malloc(2 * xLen * sizeof(char)); // at most one insertion per letter of x
+	yLen = 0;
+	int i;
+	for (i = 0; i < xLen; i++) {
+		uint64_t r = random_at(2, i);
+		if ((r & 0xFFFF) * 100 >= (uint64_t) mutateRate * 0x10000) // no mutation here
+			y[yLen++] = x[i];
+		else if ((r >> 16) % 3 == 0) { // substitution by a different letter (if there is one)
+			int letter = x[i] - 'A';
+			if (alphabetSize > 1)
+				letter = (letter + 1 + (r >> 32) % (alphabetSize - 1)) % alphabetSize;
+			y[yLen++] = letter + 'A';
+		}
+		else if ((r >> 16) % 3 == 1) { // insertion of a random letter before x[i]
+			y[yLen++] = (r >> 32) % alphabetSize + 'A';
+			y[yLen++] = x[i];
+		}
+		// otherwise deletion of x[i]
+	}
+	if (yLen == 0) // keep y non-empty
+		y[yLen++] = x[0];
 }
 
 // generate two strings x and y (of lengths xLen and yLen respectively) uniformly at random over an alphabet of size alphabetSize
+// if mutateBool is set, y is instead derived from x (yLen is then the length of the result)
 void generateStrings() {
-	// allocate memory for x and y
-	x = malloc(xLen * sizeof(char));
-	y = malloc(yLen * sizeof(char));
-	// instantiate the pseudo-random number generator (seeded based on current time)
-	srand(time(NULL));
-	int i;
+	// seed based on current time unless seed given, and report it so the run can be reproduced
+	if (!seedBool)
+		seed = time(NULL);
+	printf("Seed: %llu\n\n", (unsigned long long) seed);
 	// generate x, of length xLen
-	for (i = 0; i < xLen; i++)
-		x[i] = rand()%alphabetSize +'A';
-	// generate y, of length yLen
-	for (i = 0; i < yLen; i++)
-		y[i] = rand()%alphabetSize +'A';
+	x = malloc(xLen * sizeof(char));
+	fill_string(x, xLen, 0);
+	// generate y, of length yLen, or derive it from x
+	if (mutateBool)
+		mutate_string();
+	else {
+		y = malloc(yLen * sizeof(char));
+		fill_string(y, yLen, 1);
+	}
+}
+
+// write generated strings to file given by outFilename, in the format read by readStrings; return true if and only if successful
+bool writeStrings() {
+	FILE * file;
+	file = fopen(outFilename, "w");
+	if (!file) { // notify user of I/O error and return false
+		printf("Problem opening file %s\n",outFilename);
+		return false;
+	}
+	bool success = fwrite(x, sizeof(char), xLen, file) == (size_t) xLen && fputc('\n', file) != EOF
+		&& fwrite(y, sizeof(char), yLen, file) == (size_t) yLen && fputc('\n', file) != EOF;
+	success &= fclose(file) == 0;
+	if (success)
+		printf("Strings of lengths %d and %d written to %s\n", xLen, yLen, outFilename);
+	else
+		printf("Problem writing file %s\n",outFilename);
+	return success;
 }
 
 // free memory occupied by strings
 void freeMemory() {
+	if (mappedFile) { // strings point into the mapped file
+		munmap(mappedFile, mappedSize);
+		mappedFile = NULL;
+		return;
+	}
   free(x);
 	free(y);
 }
@@ -264,8 +509,12 @@ bool is_real_value(int i, int j){
 
 //Adds to the 2-d virtually initialized array
 void add_to_table(int i, int j, int value){
-        //Add one to insertion counter
         table[i][j].entry = value;
+        //Two-row table keeps no record of insertions
+        if (rollingTable){
+                return;
+        }
+        //Add one to insertion counter
         table[i][j].pointer = ins_count;
         comp_array[ins_count].x_index = i;
         comp_array[ins_count].y_index = j;
@@ -295,10 +544,36 @@ void init_table(int x_size, int y_size){
   ins_count = 0;
 }
 
+//Initialise a table of which only two rows are real, row i sharing memory with row i-2
+//Enough for the iterative algorithms when the table is not to be printed
+void init_rolling_table(int x_size, int y_size){
+  int i;
+  table = (tableTuple **) malloc ((x_size+1)*sizeof(tableTuple *));
+  if(table == NULL){
+    printf("Malloc error");
+  }
+  tableTuple *rows = (tableTuple *) malloc (2*(y_size+1)*sizeof(tableTuple));
+  if(rows == NULL){
+    printf("Malloc error");
+  }
+  for (i=0; i <= x_size; i++){
+    table[i] = rows + (i % 2)*(y_size+1);
+  }
+  comp_array = NULL;
+  ins_count = 0;
+  rollingTable = true;
+}
+
 //free_table - frees the table and second array from the memory
 void free_table(){
   int i;
-  for (i=0; i<= yLen;i++){
+  if (rollingTable){
+    free(table[0]);
+    free(table);
+    rollingTable = false;
+    return;
+  }
+  for (i=0; i<= xLen;i++){
     free(table[i]);
   }
   free(table);
@@ -306,15 +581,92 @@ void free_table(){
 }
 
 
+//Traceback functions
+//init_traceback - allocates a zeroed (all TB_STOP) traceback for the table
+void init_traceback(int x_size, int y_size){
+  long long cells = (long long)(x_size+1)*(y_size+1);
+  traceback = (uint64_t *) calloc((cells + 31) / 32, sizeof(uint64_t));
+  if(traceback == NULL){
+    printf("Malloc error");
+  }
+  align_end_i = x_size;
+  align_end_j = y_size;
+}
+
+//tb_set - records the direction of cell (i,j); each cell is set at most once
+void tb_set(int i, int j, int code){
+  long long cell = (long long)i*(yLen+1) + j;
+  traceback[cell >> 5] |= (uint64_t)code << ((cell & 31) * 2);
+}
+
+//tb_get - gets the direction of cell (i,j)
+int tb_get(int i, int j){
+  long long cell = (long long)i*(yLen+1) + j;
+  return (traceback[cell >> 5] >> ((cell & 31) * 2)) & 3;
+}
+
+//trace_direction - which neighbour cell (i,j) of an iterative table took its value from
+int trace_direction(int alg, int i, int j, int value){
+  if (((i == 0) & (j == 0)) | ((alg == 3) & (value == 0))){
+    return TB_STOP;
+  }
+  if (i == 0){
+    return TB_LEFT;
+  }
+  if (j == 0){
+    return TB_UP;
+  }
+  switch (alg){
+    case 1:
+      //LCS - prefer left, then above, as equal values mean no match was used
+      if (table[i][j-1].entry == value){
+        return TB_LEFT;
+      }else if (table[i-1][j].entry == value){
+        return TB_UP;
+      }
+      return TB_DIAG;
+    default: {
+      //ED and SW - a match or substitution, else a gap
+      int step = (alg == 2) ? 1 : -1;
+      if ((x[i-1] == y[j-1]) || (table[i-1][j-1].entry + step == value)){
+        return TB_DIAG;
+      }else if (table[i-1][j].entry + step == value){
+        return TB_UP;
+      }
+      return TB_LEFT;
+    }
+  }
+}
+
+//init_iterative - sets up the table and, if an alignment is to be printed, the traceback for an iterative algorithm
+//Only two rows of the table are kept if the table itself is not to be printed
+void init_iterative(int alg){
+  if (alignBool || (printBool & (alg == 1))){
+    init_traceback(xLen, yLen);
+  }
+  if (printBool){
+    init_table(xLen, yLen);
+  }else{
+    init_rolling_table(xLen, yLen);
+  }
+}
+
+//free_iterative - frees the table and traceback of an iterative algorithm
+void free_iterative(){
+  free_table();
+  free(traceback);
+  traceback = NULL;
+}
+
+
 //Printing functions
 //print_space - just prints multiple tabs for format
 void print_space(int width){
 	printf("%-*s%-*s%-*s", width, " ", width, " ", width, " ");
 }
 
-//print_table - prints out a neat table for the algorithms
-//args - the table - int[][]
-void print_table(int col_width){
+//print_table_header - prints the x axis of a table
+void print_table_header(int col_width){
 
 	int i;
 	int j;
@@ -341,12 +693,11 @@ void print_table(int col_width){
 				printf("-");
 			}
 	}
-
-	//For every row
 	printf("\n");
-	for (i=0; i<=xLen; i++){
+}
 
-		//Print y axis
+//print_row_label - prints the y axis for row i of a table
+void print_row_label(int i, int col_width){
 		printf("%-*d", col_width, i % 10);
 		if (i==0){
 			printf("%-*s", col_width, " ");
@@ -354,6 +705,21 @@ void print_table(int col_width){
 			printf("%-*c", col_width, x[i-1]);
 		}
 		printf("%-*s", col_width, "|");
+}
+
+//print_table - prints out a neat table for the algorithms
+//args - the table - int[][]
+void print_table(int col_width){
+
+	int i;
+	int j;
+	print_table_header(col_width);
+
+	//For every row
+	for (i=0; i<=xLen; i++){
+
+		//Print y axis
+		print_row_label(i, col_width);
 
 		//Print table values
 		for (j=0; j<=yLen; j++){
@@ -372,39 +738,86 @@ void print_table(int col_width){
 	}
 }
 
-//print_align - prints the optimal alignment for a LCS table
+//count_to_string - writes a 128-bit count in decimal into buf (at least 40 chars)
+void count_to_string(bigCount c, char *buf){
+  char digits[40];
+  int n = 0;
+  do {
+    digits[n++] = '0' + (int)(c % 10);
+    c /= 10;
+  } while (c > 0);
+  int i;
+  for (i=0; i<n; i++){
+    buf[i] = digits[n-1-i];
+  }
+  buf[n] = '\0';
+}
+
+//print_count_table - prints the table of analytic recursion counts, marking counts that exceeded 128 bits
+void print_count_table(){
+  int i, j;
+  char buf[40];
+  long long cells = (long long)(xLen+1)*(yLen+1);
+  bigCount saturated = ~(bigCount)0;
+  //Width from the total, as for the table of recursive calls, or from the largest cell within 128 bits
+  bigCount biggest = count_overflow ? 0 : rec_count_big;
+  for (i=0; count_overflow && i<cells; i++){
+    if ((count_table[i] != saturated) & (count_table[i] > biggest)){
+      biggest = count_table[i];
+    }
+  }
+  count_to_string(biggest, buf);
+  int col_width = strlen(buf) + 2;
+  if (count_overflow){
+    col_width = max2(col_width, strlen(">2^128") + 2);
+  }
+  print_table_header(col_width);
+  for (i=0; i<=xLen; i++){
+    print_row_label(i, col_width);
+    for (j=0; j<=yLen; j++){
+      bigCount c = count_table[(long long)i*(yLen+1)+j];
+      if (c == saturated){
+        printf("%-*s", col_width, ">2^128");
+      }else{
+        count_to_string(c, buf);
+        printf("%-*s", col_width, buf);
+      }
+    }
+    printf("\n");
+  }
+}
+
+//print_align - prints the optimal alignment by following the traceback
 void print_align(){
   int i,j;
-  i = xLen;
-  j = yLen;
-  int current_val;
+  i = align_end_i;
+  j = align_end_j;
+  int code;
   char *first_line = malloc((xLen+yLen) * sizeof(char));
   char *snd_line = malloc((xLen+yLen) * sizeof(char));
   char *third_line = malloc((xLen+yLen) * sizeof(char));
   int count = 0;
 
   //Get optimal alignment
-  while (i > 0 | j > 0){
-    current_val = table[i][j].entry;
-
-    //If cell to left is equal, move to that cell
-    if (j > 0 & (table[i][j-1].entry == current_val)){
+  while ((code = tb_get(i, j)) != TB_STOP){
+    //Move to cell to left
+    if (code == TB_LEFT){
       first_line[count] = '-';
       snd_line[count] = ' ';
       third_line[count] = y[j-1];
       j--;
     }
-    //If cell above is equal, move to that cell
-    else if (i > 0 & (table[i-1][j].entry == current_val)){
+    //Move to cell above
+    else if (code == TB_UP){
       first_line[count] = x[i-1];
       snd_line[count] = ' ';
       third_line[count] = '-';
       i--;
     }
-    //Else move to top-left diagonal cell
+    //Move to top-left diagonal cell
     else{
       first_line[count] = x[i-1];
-      snd_line[count] = '|';
+      snd_line[count] = (x[i-1] == y[j-1]) ? '|' : ' ';
       third_line[count] = y[j-1];
       i--;
       j--;
@@ -456,6 +869,25 @@ void print_answer(int alg, int type){
       double prop_comp = (((double)ins_count*100)/(double)cells);
       printf("Proportion of table computed: %.1f%%\n", prop_comp);
       break;
+    case 4: {
+      char buf[40];
+      count_to_string(rec_count_big, buf);
+      if (count_overflow){
+        //From natural logarithm to mantissa and decimal exponent
+        double exponent = floor(rec_count_log / log(10));
+        double mantissa = pow(10, rec_count_log / log(10) - exponent);
+        printf("Total number of times entry computed: approximately %.6fe+%.0f (exceeds 128 bits)\n", mantissa, exponent);
+      }else{
+        printf("Total number of times entry computed: %s\n", buf);
+      }
+      break;
+    }
+  }
+
+  //Print out table of analytic counts if required
+  if (printBool && type == 4){
+    print_count_table();
+    return;
   }
 
   //Print out table if required
@@ -464,13 +896,483 @@ void print_answer(int alg, int type){
     int biggest = max3(1, answer, rec_counter);
     int col_width = floor (log10 (abs (biggest))) + 3;
     print_table(col_width);
+  }
+
+  //If to print out optimal alignment
+  if ((type == 1) & (traceback != NULL)){
+    printf("\n");
+    print_align();
+  }
+}
+
+
+//Analytic recursion counts
+//add_count - adds two counts, saturating (and flagging) on overflow
+bigCount add_count(bigCount a, bigCount b){
+  if (a + b < a){
+    count_overflow = true;
+    return ~(bigCount)0;
+  }
+  return a + b;
+}
+
+//log_add - logarithm of the sum of two numbers given by their (natural) logarithms, -INFINITY being the logarithm of 0
+//Terms more than e^40 smaller than the other cannot change a double, so they skip the exp and log1p
+double log_add(double a, double b){
+  if (a < b){
+    double tmp = a;
+    a = b;
+    b = tmp;
+  }
+  if (b == -INFINITY || b - a < -40){
+    return a;
+  }
+  return a + log1p(exp(b - a));
+}
+
+//log_count_pass - natural logarithm of the count of recursive calls, for when the exact count exceeds 128 bits
+//Same recurrence as rec_count_alg, on two rows of logarithms (-INFINITY for a count of 0), so it never overflows
+double log_count_pass(bool ed_alg){
+  int i, j;
+  long long width = yLen + 1;
+  double total = -INFINITY;
+  double *log_rows = (double *) malloc(2 * width * sizeof(double));
+  if (log_rows == NULL){
+    printf("Malloc error");
+  }
+  for (i=xLen; i >= 0; i--){
+    double *cur = log_rows + (i % 2) * width;
+    double *below = log_rows + ((i + 1) % 2) * width;
+    for (j=yLen; j >= 0; j--){
+      double c = ((i == xLen) & (j == yLen)) ? 0 : -INFINITY;
+      if ((i < xLen) & (j < yLen) && (ed_alg || x[i] == y[j])){
+        c = log_add(c, below[j+1]);
+      }
+      if ((i < xLen) & (j > 0) && x[i] != y[j-1]){
+        c = log_add(c, below[j]);
+      }
+      if ((j < yLen) & (i > 0) && x[i-1] != y[j]){
+        c = log_add(c, cur[j+1]);
+      }
+      cur[j] = c;
+      total = log_add(total, c);
+    }
+  }
+  free(log_rows);
+  return total;
+}
+
+//rec_count_alg - counts the calls the recursive algorithm without memoisation would make, in O(mn) time
+//Cell (i,j) is called once by each call of a cell that recurses into it, so counts are pushed down from (xLen,yLen)
+//Table of counts is kept only if it is to be printed, otherwise two rows suffice
+//Only if a count exceeds 128 bits is a second pass made, in logarithms, to approximate the total
+//Returns the answer, computed iteratively with two rows
+int rec_count_alg(int alg){
+  int i, j;
+  long long width = yLen + 1;
+  bool ed_alg = (alg == 2);
+  count_table = (bigCount *) malloc((printBool ? xLen + 1 : 2) * width * sizeof(bigCount));
+  if (count_table == NULL){
+    printf("Malloc error");
+  }
+  rec_count_big = 0;
+  count_overflow = false;
+
+  for (i=xLen; i >= 0; i--){
+    bigCount *cur = count_table + (printBool ? i : i % 2) * width;
+    bigCount *below = count_table + (printBool ? i + 1 : (i + 1) % 2) * width;
+    for (j=yLen; j >= 0; j--){
+      bigCount c = (i == xLen) & (j == yLen);
+      //Diagonal call from (i+1,j+1) - always for ED, only on a match for LCS
+      if ((i < xLen) & (j < yLen) && (ed_alg || x[i] == y[j])){
+        c = add_count(c, below[j+1]);
+      }
+      //Call from (i+1,j) on a mismatch
+      if ((i < xLen) & (j > 0) && x[i] != y[j-1]){
+        c = add_count(c, below[j]);
+      }
+      //Call from (i,j+1) on a mismatch
+      if ((j < yLen) & (i > 0) && x[i-1] != y[j]){
+        c = add_count(c, cur[j+1]);
+      }
+      cur[j] = c;
+      rec_count_big = add_count(rec_count_big, c);
+    }
+  }
+  if (count_overflow){
+    rec_count_log = log_count_pass(ed_alg);
+  }
+
+  //Answer from the same recurrence as the recursive algorithm
+  int *rows = (int *) malloc(2 * width * sizeof(int));
+  for (i=0; i <= xLen; i++){
+    int *row = rows + (i % 2) * width;
+    int *above = rows + ((i + 1) % 2) * width;
+    for (j=0; j <= yLen; j++){
+      if ((i == 0) | (j == 0)){
+        row[j] = 0;
+      }else if (x[i-1] == y[j-1]){
+        row[j] = above[j-1] + !ed_alg;
+      }else if (ed_alg){
+        row[j] = min3(above[j], row[j-1], above[j-1]) + 1;
+      }else{
+        row[j] = max2(above[j], row[j-1]);
+      }
+    }
+  }
+  int value = rows[(xLen % 2) * width + yLen];
+  free(rows);
+  return value;
+}
+
+//Result cache functions
+//The cache file is a header, an open-addressing index of slots (record number + 1, 0 if empty) and fixed-size records,
+//so a lookup maps the file and reads only the slots it probes and the records they point to
+//Writers lock the file exclusively and write a record before the slot pointing to it; readers need no lock, and skip a
+//slot pointing past the records they mapped or to a record failing its checksum (a record only partly written, or torn)
+//When the index would be more than half full, the file is rebuilt with twice the slots and renamed over the old one
+#define CACHE_MAGIC 0x3248434143584100ULL //"\0AXCACH2"
+#define CACHE_HEADER 64 //Bytes before the index
+#define CACHE_MIN_SLOTS 1024 //Slots of a new file, a power of two
+#define CACHE_BATCH 4096 //Records buffered by each all-pairs thread before appending
+
+//Header at the start of the file, padded to CACHE_HEADER bytes
+typedef struct {
+  uint64_t magic;
+  uint64_t slots; //Number of index slots, a power of two
+} cacheHeader;
+
+//Record of one result - key is the two strings (by hash and length), the algorithm and its parameters
+typedef struct {
+  uint64_t x_hash;
+  uint64_t y_hash;
+  int32_t x_len;
+  int32_t y_len;
+  int32_t params; //Algorithm
+  int32_t threshold; //Threshold of all pairs, -1 if none
+  int32_t answer;
+  uint32_t check; //Checksum of the fields above
+} cacheRecord;
+
+char *cache_map = NULL; //Mapping of the file as it was when opened
+size_t cache_map_size = 0; //Size of mapping
+uint32_t *cache_slots = NULL; //Mapped index
+long long cache_slot_count = 0; //Power of two
+cacheRecord *cache_records = NULL; //Mapped records
+long long cache_count = 0; //Number of mapped records
+char *cache_wmap = NULL; //Writable mapping of the file appended to, kept between appends so pages fault only once
+size_t cache_wmap_size = 0; //Size of writable mapping, which may run past the end of the file
+struct stat cache_wmap_st; //File of writable mapping
+pthread_mutex_t append_lock = PTHREAD_MUTEX_INITIALIZER; //Taken once per append, so threads share the writable mapping
+long long cache_hits = 0, cache_misses = 0; //Run statistics
+
+//hash_string - 64-bit hash of a string, 8 bytes at a time
+uint64_t hash_string(const char *s, int len){
+  uint64_t h = mix64(len);
+  int i;
+  for (i=0; i+8 <= len; i+=8){
+    uint64_t block;
+    memcpy(&block, s+i, 8);
+    h = mix64(h ^ block);
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, s+i, len-i);
+  return mix64(h ^ tail);
+}
+
+//record_check - checksum of a record
+uint32_t record_check(const cacheRecord *r){
+  uint64_t h = mix64(r->x_hash ^ mix64(r->y_hash));
+  h = mix64(h ^ ((uint64_t)(uint32_t)r->x_len << 32 | (uint32_t)r->y_len));
+  h = mix64(h ^ ((uint64_t)(uint32_t)r->params << 32 | (uint32_t)r->threshold));
+  return (uint32_t)mix64(h ^ (uint32_t)r->answer);
+}
+
+//make_key - fills the key of a record; all the algorithms are symmetric, so the strings are put in hash order
+void make_key(cacheRecord *r, uint64_t x_hash, int x_len, uint64_t y_hash, int y_len, int params, int thresh){
+  bool swap = x_hash > y_hash;
+  r->x_hash = swap ? y_hash : x_hash;
+  r->y_hash = swap ? x_hash : y_hash;
+  r->x_len = swap ? y_len : x_len;
+  r->y_len = swap ? x_len : y_len;
+  r->params = params;
+  r->threshold = thresh;
+}
+
+//same_key - whether two records have the same key
+bool same_key(const cacheRecord *a, const cacheRecord *b){
+  return a->x_hash == b->x_hash && a->y_hash == b->y_hash && a->x_len == b->x_len && a->y_len == b->y_len
+    && a->params == b->params && a->threshold == b->threshold;
+}
+
+//data_offset - offset of the records in a file with the given number of slots
+long long data_offset(long long slots){
+  return CACHE_HEADER + slots * (long long)sizeof(uint32_t);
+}
+
+//cache_probe - probes an index for a key, over the first count records; returns the slot holding the key if found
+//(its value in *value), else the empty slot where it would go (*value 0)
+long long cache_probe(const uint32_t *slots, long long slot_count, const cacheRecord *records, long long count,
+  const cacheRecord *key, uint32_t *value){
+  long long slot = mix64(key->x_hash ^ mix64(key->y_hash ^ key->params) ^ key->threshold) & (slot_count - 1);
+  while ((*value = __atomic_load_n(&slots[slot], __ATOMIC_ACQUIRE)) != 0){
+    const cacheRecord *r = &records[*value - 1];
+    if (*value <= count && record_check(r) == r->check && same_key(r, key)){
+      break;
+    }
+    slot = (slot + 1) & (slot_count - 1);
+  }
+  return slot;
+}
+
+//read_header - reads the header and checks it against the file size; return true if and only if valid
+bool read_header(int fd, cacheHeader *header, struct stat *st){
+  return fstat(fd, st) == 0 && pread(fd, header, sizeof(cacheHeader), 0) == sizeof(cacheHeader)
+    && header->magic == CACHE_MAGIC && header->slots > 0 && (header->slots & (header->slots - 1)) == 0
+    && st->st_size >= data_offset(header->slots);
+}
+
+//cache_open - maps cacheFilename, creating it if needed; only the header is read
+void cache_open(){
+  int fd = open(cacheFilename, O_RDWR | O_CREAT, 0644);
+  if (fd < 0){
+    printf("Problem opening file %s\n", cacheFilename);
+    cacheBool = false;
+    return;
+  }
+  //Write header if new (or left incomplete), under an exclusive lock only then so readers don't queue
+  cacheHeader header;
+  struct stat st;
+  bool success = read_header(fd, &header, &st);
+  if (!success){
+    flock(fd, LOCK_EX);
+    success = read_header(fd, &header, &st);
+    if (!success && fstat(fd, &st) == 0
+      && (st.st_size < CACHE_HEADER || (pread(fd, &header, sizeof(header), 0) == sizeof(header) && header.magic == 0))){
+      char zeros[CACHE_HEADER] = {0};
+      header.magic = CACHE_MAGIC;
+      header.slots = CACHE_MIN_SLOTS;
+      memcpy(zeros, &header, sizeof(header));
+      success = ftruncate(fd, 0) == 0 && ftruncate(fd, data_offset(CACHE_MIN_SLOTS)) == 0
+        && pwrite(fd, zeros, CACHE_HEADER, 0) == CACHE_HEADER && read_header(fd, &header, &st);
+    }
+    flock(fd, LOCK_UN);
+  }
+  if (!success){
+    printf("Incorrect cache file %s\n", cacheFilename);
+    close(fd);
+    cacheBool = false;
+    return;
+  }
+
+  //Map the index and the whole records present now
+  cache_slot_count = header.slots;
+  cache_count = (st.st_size - data_offset(header.slots)) / (long long)sizeof(cacheRecord);
+  cache_map_size = st.st_size;
+  cache_map = mmap(NULL, cache_map_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (cache_map == MAP_FAILED){
+    printf("Problem opening file %s\n", cacheFilename);
+    cache_map = NULL;
+    cacheBool = false;
+    return;
+  }
+  cache_slots = (uint32_t *) (cache_map + CACHE_HEADER);
+  cache_records = (cacheRecord *) (cache_map + data_offset(header.slots));
+}
+
+//cache_lookup - finds the answer for a key; return true if and only if found. Safe to call from several threads
+bool cache_lookup(cacheRecord *key, int *result){
+  uint32_t value;
+  cache_probe(cache_slots, cache_slot_count, cache_records, cache_count, key, &value);
+  if (value != 0){
+    *result = cache_records[value - 1].answer;
+    __atomic_fetch_add(&cache_hits, 1, __ATOMIC_RELAXED);
+    return true;
+  }
+  __atomic_fetch_add(&cache_misses, 1, __ATOMIC_RELAXED);
+  return false;
+}
+
+//cache_rebuild - copies the valid records of a locked file of count records into a new file with enough slots for
+//extra more, locks it and renames it over the old one; returns the new file, or -1 if unsuccessful
+int cache_rebuild(int fd, cacheHeader *header, long long count, long long extra){
+  char tmp_name[4096];
+  snprintf(tmp_name, sizeof(tmp_name), "%s.tmp.%ld", cacheFilename, (long) getpid());
+  int tmp_fd = open(tmp_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (tmp_fd < 0){
+    return -1;
+  }
+  flock(tmp_fd, LOCK_EX);
+  long long slots = header->slots;
+  while ((count + extra) * 2 > slots){
+    slots *= 2;
+  }
+  size_t old_size = data_offset(header->slots) + count * sizeof(cacheRecord);
+  size_t new_size = data_offset(slots) + count * sizeof(cacheRecord);
+  char *old_map = mmap(NULL, old_size, PROT_READ, MAP_SHARED, fd, 0);
+  char *new_map = MAP_FAILED;
+  bool success = old_map != MAP_FAILED && ftruncate(tmp_fd, new_size) == 0;
+  if (success){
+    new_map = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, tmp_fd, 0);
+    success = new_map != MAP_FAILED;
+  }
+  long long i, kept = 0;
+  if (success){
+    cacheRecord *old_records = (cacheRecord *) (old_map + data_offset(header->slots));
+    cacheRecord *new_records = (cacheRecord *) (new_map + data_offset(slots));
+    uint32_t *new_slots = (uint32_t *) (new_map + CACHE_HEADER);
+    for (i=0; i<count; i++){
+      uint32_t value;
+      if (record_check(&old_records[i]) != old_records[i].check){
+        continue;
+      }
+      long long slot = cache_probe(new_slots, slots, new_records, kept, &old_records[i], &value);
+      if (value == 0){
+        new_records[kept] = old_records[i];
+        new_slots[slot] = (uint32_t) ++kept;
+      }
+    }
+    header->slots = slots;
+    memcpy(new_map, header, sizeof(cacheHeader));
+  }
+  if (old_map != MAP_FAILED){
+    munmap(old_map, old_size);
+  }
+  if (new_map != MAP_FAILED){
+    munmap(new_map, new_size);
+  }
+  success = success && ftruncate(tmp_fd, data_offset(slots) + kept * sizeof(cacheRecord)) == 0
+    && rename(tmp_name, cacheFilename) == 0;
+  if (!success){
+    unlink(tmp_name);
+    close(tmp_fd);
+    return -1;
+  }
+  close(fd);
+  return tmp_fd;
+}
+
+//cache_append - adds n records to the file, with their slots, skipping any already there. Safe to call from several
+//threads and processes; return true if and only if successful
+bool cache_append(const cacheRecord *new_records, long long n){
+  //Lock the file currently at the path, as a rebuild may have replaced the one opened
+  int fd;
+  cacheHeader header;
+  struct stat st, path_st;
+  pthread_mutex_lock(&append_lock);
+  while (true){
+    fd = open(cacheFilename, O_RDWR);
+    if (fd < 0){
+      pthread_mutex_unlock(&append_lock);
+      return false;
+    }
+    flock(fd, LOCK_EX);
+    if (!read_header(fd, &header, &st)){
+      close(fd);
+      pthread_mutex_unlock(&append_lock);
+      return false;
+    }
+    if (stat(cacheFilename, &path_st) == 0 && path_st.st_ino == st.st_ino && path_st.st_dev == st.st_dev){
+      break;
+    }
+    close(fd);
+  }
+
+  //Records are whole ones only; anything after them was torn and is written over
+  bool success = true;
+  long long count = (st.st_size - data_offset(header.slots)) / (long long)sizeof(cacheRecord);
+  if ((count + n) * 2 > (long long) header.slots){
+    int new_fd = cache_rebuild(fd, &header, count, n);
+    success = new_fd >= 0 && read_header(new_fd, &header, &st);
+    fd = (new_fd < 0) ? fd : new_fd;
+    count = (st.st_size - data_offset(header.slots)) / (long long)sizeof(cacheRecord);
+  }
+  size_t size = data_offset(header.slots) + (count + n) * sizeof(cacheRecord);
+  success = success && ftruncate(fd, size) == 0;
+
+  //Map again only for a different file or one grown past the mapping, with room to grow
+  if (success && (cache_wmap == NULL || st.st_ino != cache_wmap_st.st_ino || st.st_dev != cache_wmap_st.st_dev
+    || size > cache_wmap_size)){
+    if (cache_wmap != NULL){
+      munmap(cache_wmap, cache_wmap_size);
+    }
+    cache_wmap_size = 2 * size;
+    cache_wmap = mmap(NULL, cache_wmap_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    cache_wmap_st = st;
+    if (cache_wmap == MAP_FAILED){
+      cache_wmap = NULL;
+      success = false;
+    }
+  }
+  if (success){
+    uint32_t *slots = (uint32_t *) (cache_wmap + CACHE_HEADER);
+    cacheRecord *records = (cacheRecord *) (cache_wmap + data_offset(header.slots));
+    long long i, added = 0;
+    for (i=0; i<n; i++){
+      uint32_t value;
+      long long slot = cache_probe(slots, header.slots, records, count + added, &new_records[i], &value);
+      if (value == 0){
+        records[count + added] = new_records[i];
+        added++;
+        __atomic_store_n(&slots[slot], (uint32_t)(count + added), __ATOMIC_RELEASE);
+      }
+    }
+    //Only slots of records kept point into the file, so no reader touches what is cut off
+    success = added == n || ftruncate(fd, data_offset(header.slots) + (count + added) * sizeof(cacheRecord)) == 0;
+  }
+  flock(fd, LOCK_UN);
+  close(fd);
+  pthread_mutex_unlock(&append_lock);
+  return success;
+}
+
+//cache_store - appends the answer for a key to the file
+void cache_store(cacheRecord *key, int result){
+  key->answer = result;
+  key->check = record_check(key);
+  if (!cache_append(key, 1)){
+    printf("Problem writing file %s\n", cacheFilename);
+  }
+}
 
-    //If to print out optimal alignment
-    if (alg == 1 & type == 1){
-      printf("\n");
-      print_align();
+//cache_close - prints hit/miss counts and unmaps the cache
+void cache_close(){
+  printf("Cache hits: %lld, misses: %lld\n", cache_hits, cache_misses);
+  if (cache_map != NULL){
+    munmap(cache_map, cache_map_size);
+  }
+  if (cache_wmap != NULL){
+    munmap(cache_wmap, cache_wmap_size);
+  }
+}
+
+//run_iterative - runs an iterative algorithm and prints, answering from the cache instead if only the answer is wanted
+void run_iterative(int alg, int (*alg_fn)()){
+  cacheRecord key;
+  bool use_cache = cacheBool && !printBool && !alignBool;
+  if (use_cache){
+    clock_t start = clock();
+    make_key(&key, hash_string(x, xLen), xLen, hash_string(y, yLen), yLen, alg_type, -1);
+    if (cache_lookup(&key, &answer)){
+      double time_spent = (double)(clock() - start) / CLOCKS_PER_SEC;
+      printf("Iterative version (cached)\n");
+      print_answer(alg, 1);
+      printf("Time taken: %f seconds\n\n", (time_spent));
+      return;
     }
   }
+  printf("Iterative version\n");
+  init_iterative(alg);
+  clock_t start = clock();
+  answer = alg_fn();
+  double time_spent = (double)(clock() - start) / CLOCKS_PER_SEC;
+  print_answer(alg, 1);
+  free_iterative();
+  printf("Time taken: %f seconds\n\n", (time_spent));
+  if (use_cache){
+    cache_store(&key, answer);
+  }
 }
 
 
@@ -493,6 +1395,9 @@ int lcs_iterative_alg(){
         value = max2(table[i-1][j].entry, table[i][j-1].entry);
 			}
       add_to_table(i, j, value);
+      if (traceback != NULL){
+        tb_set(i, j, trace_direction(1, i, j, value));
+      }
 		}
 	}
 	return table[xLen][yLen].entry;
@@ -564,14 +1469,7 @@ int lcs_recursive_memo_alg(int a, int b){
 void lcs() {
 	//Call required algorithms
 	if (iterBool){
-    printf("Iterative version\n");
-    init_table(xLen, yLen);
-    clock_t start = clock();
-		answer = lcs_iterative_alg();
-    double time_spent = (double)(clock() - start) / CLOCKS_PER_SEC;
-    print_answer(1, 1);
-    free_table();
-    printf("Time taken: %f seconds\n\n", (time_spent));
+    run_iterative(1, lcs_iterative_alg);
 	}
 	if (recNoMemoBool){
     printf("Recursive version without memoisation\n");
@@ -599,6 +1497,15 @@ void lcs() {
     printf("Time taken: %f seconds\n\n", (time_spent));
     rec_counter = 0;
 	}
+  if (analyticBool){
+    printf("Recursive version without memoisation (analytic count)\n");
+    clock_t start = clock();
+    answer = rec_count_alg(1);
+    double time_spent = (double)(clock() - start) / CLOCKS_PER_SEC;
+    print_answer(1, 4);
+    free(count_table);
+    printf("Time taken: %f seconds\n\n", (time_spent));
+  }
 }
 
 
@@ -620,6 +1527,9 @@ int ed_iterative_alg(){
         value = min3(table[i-1][j].entry, table[i][j-1].entry, table[i-1][j-1].entry) + 1;
 			}
     add_to_table(i, j, value);
+    if (traceback != NULL){
+      tb_set(i, j, trace_direction(2, i, j, value));
+    }
 		}
 	}
 	return table[xLen][yLen].entry;
@@ -695,15 +1605,7 @@ int ed_recursive_memo_alg(int i, int j){
 void ed(){
   //Call required algorithms
   if (iterBool){
-    printf("Iterative version\n");
-    init_table(xLen, yLen);
-    clock_t start = clock();
-    answer = ed_iterative_alg();
-    double time_spent = (double)(clock() - start) / CLOCKS_PER_SEC;
-    print_answer(2, 1);
-    free_table();
-
-    printf("Time taken: %f seconds\n\n", (time_spent));
+    run_iterative(2, ed_iterative_alg);
   }
   if (recNoMemoBool){
     printf("Recursive version without memoisation\n");
@@ -731,6 +1633,15 @@ void ed(){
     printf("Time taken: %f seconds\n\n", (time_spent));
     rec_counter = 0;
   }
+  if (analyticBool){
+    printf("Recursive version without memoisation (analytic count)\n");
+    clock_t start = clock();
+    answer = rec_count_alg(2);
+    double time_spent = (double)(clock() - start) / CLOCKS_PER_SEC;
+    print_answer(2, 4);
+    free(count_table);
+    printf("Time taken: %f seconds\n\n", (time_spent));
+  }
 }
 
 
@@ -752,8 +1663,15 @@ int sw_iterative_alg(){
       else {
         value = max4((table[i-1][j].entry-1), (table[i][j-1].entry-1), (table[i-1][j-1].entry-1), 0);
       }
+    if (value > max){
+      align_end_i = i;
+      align_end_j = j;
+    }
     max = max2(value, max);
     add_to_table(i, j, value);
+    if (traceback != NULL){
+      tb_set(i, j, trace_direction(3, i, j, value));
+    }
     }
   }
   return max;
@@ -762,15 +1680,550 @@ int sw_iterative_alg(){
 //sw - calls necessary algorithms and prints
 void sw(){
   if (iterBool){
-    printf("Iterative version\n");
-    init_table(xLen, yLen);
-    clock_t start = clock();
-    answer = sw_iterative_alg();
-    double time_spent = (double)(clock() - start) / CLOCKS_PER_SEC;
-    print_answer(3, 1);
-    free_table();
-    printf("Time taken: %f seconds\n\n", (time_spent));
+    run_iterative(3, sw_iterative_alg);
+  }
+}
+
+//Packed sequence functions
+//Symbols are remapped to dense codes 0..alphabetCount-1 and stored in 64-bit words with the fewest bits per symbol that
+//fit the alphabet (e.g. 2 bits for DNA, 5 bits for the 20 amino acids), symbols never straddling two words
+//The gain is in memory only: each string is unpacked to one byte per code before the DP runs on it
+int alphabetMap[256]; //Code of each symbol, -1 if symbol not present
+int alphabetCount = 0; //Number of distinct symbols
+int packBits = 8; //Bits per packed symbol
+
+//reset_alphabet - clears the alphabet before building it
+void reset_alphabet(){
+  int c;
+  for (c=0; c<256; c++){
+    alphabetMap[c] = -1;
+  }
+  alphabetCount = 0;
+}
+
+//build_alphabet - adds the symbols of a string to the alphabet
+void build_alphabet(const char *s, int len){
+  int i;
+  for (i=0; i<len; i++){
+    unsigned char c = s[i];
+    if (alphabetMap[c] < 0){
+      alphabetMap[c] = alphabetCount++;
+    }
+  }
+}
+
+//choose_pack_bits - chooses the fewest bits per symbol that fit the alphabet
+void choose_pack_bits(){
+  packBits = 1;
+  while ((1 << packBits) < alphabetCount){
+    packBits++;
+  }
+}
+
+//packed_size - words needed to pack len symbols
+long long packed_size(int len){
+  int per_word = 64 / packBits;
+  return ((long long)len + per_word - 1) / per_word;
+}
+
+//pack_string - packs a string as codes, packBits per symbol, lowest bits first
+uint64_t *pack_string(const char *s, int len){
+  int per_word = 64 / packBits;
+  uint64_t *packed = (uint64_t *) calloc(packed_size(len), sizeof(uint64_t));
+  int i;
+  for (i=0; i<len; i++){
+    packed[i / per_word] |= (uint64_t) alphabetMap[(unsigned char) s[i]] << ((i % per_word) * packBits);
   }
+  return packed;
+}
+
+//unpack_codes - unpacks len codes into one byte per code
+void unpack_codes(const uint64_t *packed, int len, uint8_t *codes){
+  int per_word = 64 / packBits;
+  uint64_t mask = ((uint64_t) 1 << packBits) - 1;
+  int i, k;
+  for (i=0; i<len; i+=per_word){
+    uint64_t word = packed[i / per_word];
+    for (k=0; k<per_word && i+k<len; k++){
+      codes[i+k] = (word >> (k * packBits)) & mask;
+    }
+  }
+}
+
+//All-pairs functions
+uint64_t **set_packed; //Set of strings to compare, packed
+int *set_lens; //Lengths of strings in set
+uint64_t *set_hashes; //Hashes of strings in set, for the result cache
+int setSize = 0; //Number of strings in set
+int setMaxLen = 0; //Length of longest string in set
+int *matrix; //setSize x setSize matrix of results
+#define TILE_SIZE 16 //Strings per side of a tile of pairs scheduled together
+
+//Tile of the upper triangle of the matrix, rows [row, row+TILE_SIZE) by columns [col, col+TILE_SIZE)
+typedef struct {
+  int row;
+  int col;
+  long long cost; //Sum of len(a)*len(b) over pairs in the tile
+} pairTile;
+
+pairTile *tiles; //Tiles, most expensive first
+int numTiles = 0;
+int next_tile = 0; //Next tile to hand out, taken atomically by threads
+long long computed = 0; //Number of pairs computed, rather than found in the cache
+long long abandoned = 0; //Number of pairs abandoned against the threshold
+int auto_threads(long long cells); //Chooses number of threads for all pairs, see automatic engine selection
+
+//read_set - reads the set of strings, one per line; return true if and only if file read successfully
+bool read_set(){
+  FILE *file = fopen(setFilename, "r");
+  if (!file){
+    printf("Problem opening file %s\n", setFilename);
+    return false;
+  }
+  int capacity = 16;
+  char **set_strings = (char **) malloc(capacity * sizeof(char *));
+  set_lens = (int *) malloc(capacity * sizeof(int));
+  char *line = NULL;
+  size_t line_cap = 0;
+  ssize_t len;
+  while ((len = getline(&line, &line_cap, file)) != -1){
+    //Strip newline and skip empty lines
+    while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r')){
+      len--;
+    }
+    if (len == 0){
+      continue;
+    }
+    if (setSize == capacity){
+      capacity *= 2;
+      set_strings = (char **) realloc(set_strings, capacity * sizeof(char *));
+      set_lens = (int *) realloc(set_lens, capacity * sizeof(int));
+    }
+    set_strings[setSize] = (char *) malloc(len * sizeof(char));
+    memcpy(set_strings[setSize], line, len);
+    set_lens[setSize] = len;
+    setMaxLen = max2(setMaxLen, len);
+    setSize++;
+  }
+  free(line);
+  fclose(file);
+  if (setSize < 2){
+    printf("Incorrect file syntax\n");
+    return false;
+  }
+
+  //Remap to dense codes and pack, freeing each string as it is packed
+  int i;
+  long long packed_bytes = 0, plain_bytes = 0;
+  reset_alphabet();
+  for (i=0; i<setSize; i++){
+    build_alphabet(set_strings[i], set_lens[i]);
+  }
+  choose_pack_bits();
+  set_packed = (uint64_t **) malloc(setSize * sizeof(uint64_t *));
+  set_hashes = (uint64_t *) malloc(setSize * sizeof(uint64_t));
+  for (i=0; i<setSize; i++){
+    set_hashes[i] = hash_string(set_strings[i], set_lens[i]);
+    set_packed[i] = pack_string(set_strings[i], set_lens[i]);
+    packed_bytes += packed_size(set_lens[i]) * sizeof(uint64_t);
+    plain_bytes += set_lens[i];
+    free(set_strings[i]);
+  }
+  free(set_strings);
+  printf("Alphabet of %d symbols, %d bits per symbol (%lld bytes packed, %lld unpacked)\n", alphabetCount, packBits, packed_bytes, plain_bytes);
+  return true;
+}
+
+//free_set - frees the set of strings
+void free_set(){
+  int i;
+  for (i=0; i<setSize; i++){
+    free(set_packed[i]);
+  }
+  free(set_packed);
+  free(set_lens);
+  free(set_hashes);
+}
+
+//pair_alg - runs the algorithm on code strings a and b with two rows of buffer (each at least blen+1 long)
+//Same recurrences as the iterative algorithms, so results match those of a single pair
+//ED is abandoned as soon as it must exceed the threshold (result threshold+1): the path to (alen,blen) either passes
+//some cell (i,j) of row i, then needing at least |(alen-i)-(blen-j)| more gaps, each costing 1, or starts afresh at
+//some (k,0) with k > i, needing at least |(alen-k)-blen| gaps - the least of these bounds the answer below
+//(the bound is strongest with the shorter string as a)
+//LCS is abandoned as soon as it must be below the threshold (result -1); SW is never abandoned
+//Pairs found past the threshold only at the end get the same result, so it always means "past the threshold"
+int pair_alg(const uint8_t *a, int alen, const uint8_t *b, int blen, int *rows){
+  int i, j, value, best = 0;
+  int *row = rows;
+  int *above = rows + blen + 1;
+  for (j=0; j <= blen; j++){
+    row[j] = 0;
+  }
+  for (i=1; i <= alen; i++){
+    int *tmp = above;
+    above = row;
+    row = tmp;
+    row[0] = 0;
+    //Best answer still reachable from this row - LCS at most, ED at least
+    int row_best = (alg_type == ED) ? abs((alen - i) - blen) : 0;
+    if (alg_type == ED){
+      row_best = min2(row_best, (alen - i - 1 < blen) ? blen - (alen - i - 1) : 0);
+    }
+    for (j=1; j <= blen; j++){
+      if (alg_type == LCS){
+        value = (a[i-1] == b[j-1]) ? above[j-1] + 1 : max2(above[j], row[j-1]);
+        row_best = max2(row_best, value);
+      }else if (alg_type == ED){
+        value = (a[i-1] == b[j-1]) ? above[j-1] : min3(above[j], row[j-1], above[j-1]) + 1;
+        row_best = min2(row_best, value + abs((alen - i) - (blen - j)));
+      }else{
+        value = (a[i-1] == b[j-1]) ? above[j-1] + 1 : max4(above[j]-1, row[j-1]-1, above[j-1]-1, 0);
+        best = max2(best, value);
+      }
+      row[j] = value;
+    }
+    if (thresholdBool){
+      if (alg_type == ED && row_best > threshold){
+        __atomic_fetch_add(&abandoned, 1, __ATOMIC_RELAXED);
+        return threshold + 1;
+      }
+      if (alg_type == LCS && row_best + min2(alen - i, blen) < threshold){
+        __atomic_fetch_add(&abandoned, 1, __ATOMIC_RELAXED);
+        return -1;
+      }
+    }
+  }
+  if (thresholdBool && alg_type == ED && row[blen] > threshold){
+    return threshold + 1;
+  }
+  if (thresholdBool && alg_type == LCS && row[blen] < threshold){
+    return -1;
+  }
+  return (alg_type == SW) ? best : row[blen];
+}
+
+//flush_batch - appends a batch of records to the cache file
+void flush_batch(cacheRecord *batch, int batched){
+  if (!cache_append(batch, batched)){
+    printf("Problem writing file %s\n", cacheFilename);
+  }
+}
+
+//all_pairs_worker - takes tiles until none are left, computing every pair in each with its own row and code buffers
+//Each string of a tile is unpacked at most once per tile, and only if some pair of it is not in the cache
+//New results are buffered per thread and appended to the cache CACHE_BATCH at a time, with no lock per pair
+void *all_pairs_worker(void *arg){
+  (void)arg;
+  long long done = 0;
+  int *rows = (int *) malloc(2 * (setMaxLen + 1) * sizeof(int));
+  uint8_t *codes_i = (uint8_t *) malloc(setMaxLen * sizeof(uint8_t));
+  uint8_t *col_codes = (uint8_t *) malloc((long long)TILE_SIZE * setMaxLen * sizeof(uint8_t));
+  bool col_ready[TILE_SIZE];
+  cacheRecord *batch = cacheBool ? (cacheRecord *) malloc(CACHE_BATCH * sizeof(cacheRecord)) : NULL;
+  int batched = 0;
+  int t;
+  while ((t = __atomic_fetch_add(&next_tile, 1, __ATOMIC_RELAXED)) < numTiles){
+    int i, j;
+    int row_end = min2(tiles[t].row + TILE_SIZE, setSize);
+    int col_end = min2(tiles[t].col + TILE_SIZE, setSize);
+    memset(col_ready, 0, sizeof(col_ready));
+    for (i=tiles[t].row; i < row_end; i++){
+      bool row_ready = false;
+      for (j=max2(tiles[t].col, i+1); j < col_end; j++){
+        int value;
+        cacheRecord key;
+        if (cacheBool){
+          make_key(&key, set_hashes[i], set_lens[i], set_hashes[j], set_lens[j], alg_type, thresholdBool ? threshold : -1);
+          if (cache_lookup(&key, &value)){
+            matrix[(long long)i*setSize+j] = value;
+            matrix[(long long)j*setSize+i] = value;
+            continue;
+          }
+        }
+        if (!row_ready){
+          unpack_codes(set_packed[i], set_lens[i], codes_i);
+          row_ready = true;
+        }
+        uint8_t *codes_j = col_codes + (long long)(j - tiles[t].col) * setMaxLen;
+        if (!col_ready[j - tiles[t].col]){
+          unpack_codes(set_packed[j], set_lens[j], codes_j);
+          col_ready[j - tiles[t].col] = true;
+        }
+        //Keep the shorter string along the row, except for ED, which prunes better with it down the rows
+        if ((set_lens[i] >= set_lens[j]) != (alg_type == ED)){
+          value = pair_alg(codes_i, set_lens[i], codes_j, set_lens[j], rows);
+        }else{
+          value = pair_alg(codes_j, set_lens[j], codes_i, set_lens[i], rows);
+        }
+        done++;
+        if (cacheBool){
+          key.answer = value;
+          key.check = record_check(&key);
+          batch[batched++] = key;
+          if (batched == CACHE_BATCH){
+            flush_batch(batch, batched);
+            batched = 0;
+          }
+        }
+        matrix[(long long)i*setSize+j] = value;
+        matrix[(long long)j*setSize+i] = value;
+      }
+    }
+  }
+  __atomic_fetch_add(&computed, done, __ATOMIC_RELAXED);
+  if (batched > 0){
+    flush_batch(batch, batched);
+  }
+  free(batch);
+  free(rows);
+  free(codes_i);
+  free(col_codes);
+  return NULL;
+}
+
+//compare_tiles - orders tiles by decreasing cost
+int compare_tiles(const void *a, const void *b){
+  long long ca = ((pairTile *)a)->cost;
+  long long cb = ((pairTile *)b)->cost;
+  return (ca < cb) - (ca > cb);
+}
+
+//write_matrix - writes the matrix as setSize followed by setSize*setSize ints, row-major; return true if and only if successful
+bool write_matrix(){
+  FILE *file = fopen(matrixFilename, "wb");
+  if (!file){
+    printf("Problem opening file %s\n", matrixFilename);
+    return false;
+  }
+  int32_t n = setSize;
+  bool success = fwrite(&n, sizeof(int32_t), 1, file) == 1
+    && fwrite(matrix, sizeof(int), (size_t)setSize*setSize, file) == (size_t)setSize*setSize;
+  success &= fclose(file) == 0;
+  if (!success){
+    printf("Problem writing file %s\n", matrixFilename);
+  }
+  return success;
+}
+
+//all_pairs - computes the algorithm for every pair in the set, scheduling tiles of pairs over threads
+void all_pairs(){
+  if (!read_set()){
+    return;
+  }
+  printf("All pairs over %d strings\n", setSize);
+  //Wall-clock time, as CPU time adds up over threads
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  int i, j, t;
+  matrix = (int *) malloc((size_t)setSize*setSize*sizeof(int));
+  if (matrix == NULL){
+    printf("Malloc error");
+    free_set();
+    return;
+  }
+  //Diagonal - each string against itself
+  for (i=0; i<setSize; i++){
+    matrix[(long long)i*setSize+i] = (alg_type == ED) ? 0 : set_lens[i];
+    if (thresholdBool && alg_type == LCS && set_lens[i] < threshold){
+      matrix[(long long)i*setSize+i] = -1;
+    }
+  }
+
+  //Tiles of the upper triangle, most expensive first so that the long ones don't finish last
+  int per_side = (setSize + TILE_SIZE - 1) / TILE_SIZE;
+  tiles = (pairTile *) malloc((long long)per_side * (per_side + 1) / 2 * sizeof(pairTile));
+  numTiles = 0;
+  for (i=0; i<per_side; i++){
+    for (j=i; j<per_side; j++){
+      pairTile *tile = &tiles[numTiles++];
+      tile->row = i * TILE_SIZE;
+      tile->col = j * TILE_SIZE;
+      tile->cost = 0;
+      int a, b;
+      for (a=tile->row; a < min2(tile->row + TILE_SIZE, setSize); a++){
+        for (b=max2(tile->col, a+1); b < min2(tile->col + TILE_SIZE, setSize); b++){
+          tile->cost += (long long)set_lens[a] * set_lens[b];
+        }
+      }
+    }
+  }
+  qsort(tiles, numTiles, sizeof(pairTile), compare_tiles);
+  if (autoBool && !threadsBool){
+    long long cells = 0;
+    for (t=0; t<numTiles; t++){
+      cells += tiles[t].cost;
+    }
+    numThreads = min2(auto_threads(cells), numTiles);
+  }
+  next_tile = 0;
+  computed = 0;
+  abandoned = 0;
+
+  //Run threads, this one included; tiles of a thread that could not be created are taken by the others
+  pthread_t *threads = (pthread_t *) malloc(numThreads * sizeof(pthread_t));
+  bool *started = (bool *) calloc(numThreads, sizeof(bool));
+  for (t=1; t<numThreads; t++){
+    started[t] = pthread_create(&threads[t], NULL, all_pairs_worker, NULL) == 0;
+  }
+  all_pairs_worker(NULL);
+  for (t=1; t<numThreads; t++){
+    if (started[t]){
+      pthread_join(threads[t], NULL);
+    }
+  }
+  free(threads);
+  free(started);
+  free(tiles);
+
+  if (write_matrix()){
+    printf("Matrix written to %s\n", matrixFilename);
+  }
+  printf("Pairs: %lld\n", (long long)setSize*(setSize-1)/2);
+  printf("Pairs computed: %lld\n", computed);
+  if (thresholdBool){
+    printf("Pairs abandoned against threshold: %lld\n", abandoned);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double time_spent = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf("Time taken: %f seconds\n\n", (time_spent));
+  free(matrix);
+  free_set();
+}
+
+//Automatic engine selection
+//A calibration file, written once per machine by -C, records measured costs per table cell; -u uses it to
+//estimate the time for one pair and to choose the number of threads for all pairs
+//For one pair the iterative version is the only candidate: the memoised version computes most of the table on
+//typical inputs at several times the cost per cell, and the recursive version without memoisation is exponential
+#define CALIB_LEN 1500 //Length of strings used to calibrate
+#define CALIB_ALPHABET 4 //Alphabet size of strings used to calibrate
+#define MIN_THREAD_SECONDS 0.01 //Least work worth starting a thread for
+
+//Measured costs, defaults used if there is no calibration file
+struct {
+  int cpus;
+  double pair_ns; //All pairs, per cell
+  double iter_ns[2]; //Iterative version per cell, for LCS and ED
+} calib;
+
+//default_calibration - rough costs, used without a calibration file
+void default_calibration(){
+  int a;
+  calib.cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  calib.pair_ns = 3;
+  for (a=0; a<2; a++){
+    calib.iter_ns[a] = 10;
+  }
+}
+
+//alg_name - name of an algorithm in the calibration file
+char *alg_name(int alg){
+  return (alg == LCS) ? "LCS" : "ED";
+}
+
+//load_calibration - reads calibFilename; return true if and only if read successfully
+bool load_calibration(){
+  default_calibration();
+  FILE *file = fopen(calibFilename, "r");
+  if (!file){
+    return false;
+  }
+  char key[16], name[16];
+  int a, c;
+  double v1;
+  bool success = true;
+  while (success && fscanf(file, "%15s", key) == 1){
+    if (strcmp(key, "cpus") == 0){
+      success = fscanf(file, "%d", &calib.cpus) == 1;
+    }else if (strcmp(key, "pair") == 0){
+      success = fscanf(file, "%lf", &calib.pair_ns) == 1;
+    }else if (strcmp(key, "iter") == 0){
+      success = fscanf(file, "%15s %lf", name, &v1) == 2;
+      for (a=0; a<2; a++){
+        if (success && strcmp(name, alg_name(a)) == 0){
+          calib.iter_ns[a] = v1;
+        }
+      }
+    }else if (strcmp(key, "memo") == 0){
+      //Memoised costs written by earlier versions, no longer used
+      while ((c = fgetc(file)) != EOF && c != '\n');
+    }else{
+      success = false;
+    }
+  }
+  fclose(file);
+  if (!success){
+    default_calibration();
+  }
+  return success;
+}
+
+//calibrate - times the iterative and all-pairs versions on generated strings and writes calibFilename
+void calibrate(){
+  FILE *file = fopen(calibFilename, "w");
+  if (!file){
+    printf("Problem opening file %s\n", calibFilename);
+    return;
+  }
+  int a;
+  clock_t start;
+  double cells = (double)(CALIB_LEN+1)*(CALIB_LEN+1);
+  fprintf(file, "cpus %ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+  seed = 1;
+  xLen = CALIB_LEN;
+  yLen = CALIB_LEN;
+  alphabetSize = CALIB_ALPHABET;
+  x = malloc(xLen * sizeof(char));
+  y = malloc(yLen * sizeof(char));
+  fill_string(x, xLen, 0);
+  fill_string(y, yLen, 1);
+  //Iterative version
+  for (a=0; a<2; a++){
+    alg_type = a;
+    init_iterative(a+1);
+    start = clock();
+    if (a == LCS){
+      lcs_iterative_alg();
+    }else{
+      ed_iterative_alg();
+    }
+    fprintf(file, "iter %s %f\n", alg_name(a), (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / cells);
+    free_iterative();
+  }
+  //All-pairs kernel
+  int *rows = (int *) malloc(2 * (yLen + 1) * sizeof(int));
+  alg_type = ED;
+  start = clock();
+  pair_alg((uint8_t *) x, xLen, (uint8_t *) y, yLen, rows);
+  fprintf(file, "pair %f\n", (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / cells);
+  free(rows);
+  freeMemory();
+  if (fclose(file) == 0){
+    printf("Calibration written to %s\n", calibFilename);
+  }else{
+    printf("Problem writing file %s\n", calibFilename);
+  }
+}
+
+//auto_select - chooses the version for one pair, which is always the iterative version, logging its estimated time
+void auto_select(){
+  iterBool = true;
+  if (alg_type == SW){
+    printf("Auto: iterative version (only version for Smith-Waterman)\n\n");
+    return;
+  }
+  double cells = (double)(xLen+1)*(yLen+1);
+  printf("Auto: iterative version (only candidate for one pair; estimated %f seconds)\n\n", cells * calib.iter_ns[alg_type] / 1e9);
+}
+
+//auto_threads - chooses number of threads for all pairs over the given number of cells, logging the choice and why
+int auto_threads(long long cells){
+  double seconds = cells * calib.pair_ns / 1e9;
+  int threads = (int)(seconds / MIN_THREAD_SECONDS);
+  threads = max2(1, min2(threads, calib.cpus));
+  printf("Auto: %d thread%s (%d cpus, estimated %f seconds of work)\n", threads, (threads == 1) ? "" : "s", calib.cpus, seconds);
+  return threads;
 }
 
 //NEW FUNCTIONS END
@@ -781,8 +2234,25 @@ int main(int argc, char *argv[]) {
 	bool isIllegal = getArgs(argc, argv); // parse arguments from command line
 	if (isIllegal) // print error and quit if illegal arguments
 		printf("Illegal arguments\n");
+	else if (calibrateBool) // only measure costs and write them to file
+		calibrate();
+	else if (outFileBool) { // only generate strings and write them to file
+		generateStrings();
+		writeStrings();
+		freeMemory();
+	}
 	else {
 		printf("%s\n\n", alg_desc); // confirm algorithm to be executed
+		if (autoBool && !load_calibration()) // costs for automatic choice
+			printf("Auto: no usable calibration file %s, using default costs\n", calibFilename);
+		if (cacheBool) // results of earlier runs
+			cache_open();
+		if (allPairsBool) { // compare every pair in a set of strings instead
+			all_pairs();
+			if (cacheBool)
+				cache_close();
+			return 0;
+		}
 		bool success = true;
 		if (genStringsBool)
 			generateStrings(); // generate two random strings
@@ -790,6 +2260,9 @@ int main(int argc, char *argv[]) {
 			success = readStrings(); // else read strings from file
 		if (success) { // do not proceed if file input was problematic
       //CODE START
+      if (autoBool){
+        auto_select();
+      }
 
 			//Call the problem solution
 			if (alg_type==LCS){
@@ -808,6 +2281,9 @@ int main(int argc, char *argv[]) {
       //CODE END
 			freeMemory(); // free memory occupied by strings
 		}
+		if (cacheBool) { // store new results and report hits and misses
+			cache_close();
+		}
 	}
 	return 0;
 }